@@ -9,6 +9,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <signal.h>
 // #include <math.h>       // for fmod() in util
 
 // #define eprintf(...) fprintf (stderr, __VA_ARGS__)
@@ -19,6 +20,7 @@
 #define ARG_MAX 255             // max number of arguments
 #define MAX_LINE 1024           // maximum length of input lines
 #define MAX_JOBS 256            // maximum number of active commands in shellac
+#define MAX_OUTFDS 64           // maximum number of shared append descriptors held by shellac
 
 
 // // specific code for certain failure types
@@ -32,6 +34,8 @@
 #define JOBCOND_INIT  1                // just created, not started yet
 #define JOBCOND_RUN   2                // forked / exec()'d and running
 #define JOBCOND_EXIT  3                // exited normally, retval has return value
+#define JOBCOND_STOP  4                // stopped by a signal, resumes to RUN on SIGCONT
+#define JOBCOND_KILL  5                // terminated by a signal, retval has signal number
 #define JOBCOND_FAIL_EXEC  128         // numeric code indicating a failure to exec() a command
 #define JOBCOND_FAIL_OUTP  129         // numeric code indicating a failure due to output redirection
 #define JOBCOND_FAIL_INPT  130         // numeric code indicating a failure due to input redirection
@@ -43,18 +47,62 @@ typedef struct {
   char   jobname[MAX_LINE];        // name of command like "ls" or "gcc"
   char  *argv[ARG_MAX+1];          // argv for running child, NULL terminated
   int    argc;                     // number of elements on command line
-  pid_t  pid;                      // PID of child
+  pid_t  pid;                      // PID of child, also the process group ID of the job
   int    retval;                   // return value of child, -1 if not finished
   int    condition;                // one of the JOBCOND_xxx values whic indicates state of job
   char  *output_file;              // name of output file or NULL if stdout
+  char  *error_file;               // name of stderr file or NULL if stderr
   char  *input_file;               // name of input file or NULL if stdin
+  char   output_append;            // 1 if output_file is appended to (>>), 0 to truncate (>)
+  char   error_append;             // 1 if error_file is appended to (2>>), 0 to truncate (2>)
+  char   error_to_output;          // 1 if stderr follows redirected stdout (> f 2>&1 or &>), 2 if it
+                                   // follows the original stdout (2>&1 > f or no > at all), 0 otherwise
+  int    output_fd;                // shared O_APPEND descriptor for output_file or -1 to open in child
+  int    error_fd;                 // shared O_APPEND descriptor for error_file or -1 to open in child
   char   is_background;            // 1 for background job (& on command line), 0 otherwise
+  double start_time;               // session time in seconds when the job was started
 } job_t;
 
+// outfd_t: an append-mode output file opened once by shellac and
+// shared by every running job that appends to it
+typedef struct {
+  char  *path;                     // name of the file as given on the command line, NULL if unused
+  int    fd;                       // descriptor opened with O_APPEND and FD_CLOEXEC
+  int    refcount;                 // number of jobs currently using fd
+} outfd_t;
+
+// session_t: timing of a shellac session, optionally logged to a
+// record file that --replay can re-issue later
+typedef struct {
+  FILE  *record;                   // record log from --record or NULL if not recording
+  double epoch;                    // time_now() when the session began
+  int    lines;                    // number of input lines handled
+  int    jobs_started;             // number of jobs started
+  int    jobs_done;                // number of jobs that completed
+  double job_secs;                 // total start-to-exit time of completed jobs
+  double last_event;               // session time of the latest input line or job exit
+} session_t;
+
+// replay_t: input lines and statistics loaded from a record log
+typedef struct {
+  char  **lines;                   // heap copies of recorded input lines, no trailing newline
+  double *times;                   // arrival time of each line relative to the recording start
+  int     count;                   // number of entries in lines[] / times[]
+  int     next;                    // index of next line to issue
+  double  speed;                   // 1.0 for recorded speed, 2.0 twice as fast, 0 for max speed
+  double  epoch;                   // time_now() when replay began
+  int     rec_jobs_started;        // jobs started in the recording
+  int     rec_jobs_done;           // jobs completed in the recording
+  double  rec_job_secs;            // total start-to-exit time of recorded jobs
+  double  rec_elapsed;             // time of the last recorded input line or job exit
+} replay_t;
+
 // shellac_t: struct for tracking state of shellac program
 typedef struct {                
   job_t *jobs[MAX_JOBS];         // array of pointers to job_t structs; may have NULLs internally
   int job_count;                 // count of non-null job_t entries
+  outfd_t outfds[MAX_OUTFDS];    // cache of shared append descriptors; entries with NULL path are free
+  session_t session;             // session timing and optional record log
 } shellac_t;
 
 
@@ -83,6 +131,24 @@ void shellac_free_jobs(shellac_t *shellac);
 void shellac_update_one(shellac_t *shellac, int jobnum);
 void shellac_update_all(shellac_t *shellac);
 void shellac_wait_one(shellac_t *shellac, int jobnum);
+void shellac_wait_all(shellac_t *shellac);
+int shellac_signal_jobs(shellac_t *shellac, char *target, int sig);
+int shellac_outfd_acquire(shellac_t *shellac, char *path);
+void shellac_outfd_release(shellac_t *shellac, int fd);
+
+// shellac_session.c
+double time_now();
+void session_init(session_t *session);
+void session_track_exits(session_t *session);
+int session_record_open(session_t *session, char *path);
+void session_close(session_t *session);
+void session_line(session_t *session, char *line);
+void session_job_start(session_t *session, int jobnum, job_t *job);
+void session_job_done(session_t *session, int jobnum, job_t *job);
+int replay_load(replay_t *replay, char *path, double speed);
+int replay_next(replay_t *replay, char *buf, int size);
+void replay_report(replay_t *replay, session_t *session);
+void replay_free(replay_t *replay);
 
 
 // // cmd.c
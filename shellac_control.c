@@ -4,11 +4,18 @@
 
 void shellac_init(shellac_t *shellac){
 // Initialize all fields of the shellac argv[] array to NULL and set
-// the job_count to 0
+// the job_count to 0. Marks every entry of the output descriptor cache
+// as free and starts session timing with no record log.
   for (int i = 0; i < MAX_JOBS; i++){    //Loops through shellac->jobs array
     shellac->jobs[i] = NULL;    //sets each element to NULL
   }
   shellac->job_count = 0;    //set job_count to 0
+  for (int i = 0; i < MAX_OUTFDS; i++){    //loops through the descriptor cache
+    shellac->outfds[i].path = NULL;    //NULL path marks a free entry
+    shellac->outfds[i].fd = -1;
+    shellac->outfds[i].refcount = 0;
+  }
+  session_init(&shellac->session);    //session clock starts now
   return;
 }
 
@@ -36,11 +43,13 @@ int shellac_remove_job(shellac_t *shellac, int jobnum){
 // with NULL. Decrements the job count. De-allocates memory associated
 // with the job via a call to job_free(). Does basic error checking so
 // that if the specified jobnum is already NULL, prints an error to
-// that effect.
+// that effect. Releases any shared output descriptors the job held.
   if (shellac->jobs[jobnum] == NULL){    //check if the current job is NULL
     printf("ERROR: No such job '%d'\n", jobnum);    //print error
     return 1;
   } else {    //if current job is not NULL
+    shellac_outfd_release(shellac, shellac->jobs[jobnum]->output_fd);    //drop the job's shared descriptors
+    shellac_outfd_release(shellac, shellac->jobs[jobnum]->error_fd);
     job_free(shellac->jobs[jobnum]);    //free the current job
     shellac->jobs[jobnum] = NULL;    //replace the job with NULL
     shellac->job_count--;    //decreases the job count
@@ -56,9 +65,22 @@ void shellac_start_job(shellac_t *shellac, int jobnum){
 // 
 // with jobnum and jobname filled in. Then uses a call to job_start()
 // to start the job.
-  if (shellac->jobs[jobnum] != NULL){    //checks if the current job is non NULL
-    printf("=== JOB %d STARTING: %s ===\n", jobnum, shellac->jobs[jobnum]->jobname);
-    job_start(shellac->jobs[jobnum]);    //starts the current job
+//
+// Jobs appending to a file (>> or 2>>) are handed a shared descriptor
+// from the output cache so that concurrent jobs writing the same log
+// do not each open it. If the cache cannot supply one, the child falls
+// back to opening the file itself and reports any failure as usual.
+  job_t *job = shellac->jobs[jobnum];
+  if (job != NULL){    //checks if the current job is non NULL
+    printf("=== JOB %d STARTING: %s ===\n", jobnum, job->jobname);
+    if (job->output_file != NULL && job->output_append){    //">>" shares a cached descriptor
+      job->output_fd = shellac_outfd_acquire(shellac, job->output_file);
+    }
+    if (job->error_file != NULL && job->error_append){    //"2>>" shares a cached descriptor
+      job->error_fd = shellac_outfd_acquire(shellac, job->error_file);
+    }
+    job_start(job);    //starts the current job
+    session_job_start(&shellac->session, jobnum, job);    //stamps and logs the start
   }
   return;
 }
@@ -101,9 +123,21 @@ void shellac_update_one(shellac_t *shellac, int jobnum){
 // === JOB 0 COMPLETED bash [#1000]: EXIT(0) ===
 // === JOB 5 COMPLETED gcc [#22830]: EXIT(1) ===
 // === JOB 1 COMPLETED cat [#22833]: FAIL(INPT) ===
+//
+// Jobs that were stopped or continued stay in the jobs array and are
+// reported as
+//
+// === JOB 2 STOPPED sleep [#22840] ===
+// === JOB 2 CONTINUED sleep [#22840] ===
   int res = job_update_status(shellac->jobs[jobnum]);    //updates the job
-  if (res == 1){    //if update results is 1 or child is completed
+  job_t *job = shellac->jobs[jobnum];
+  if (res == 1 && job->condition == JOBCOND_STOP){    //stopped, may be continued later
+    printf("=== JOB %d STOPPED %s [#%d] ===\n", jobnum, job->jobname, job->pid);
+  } else if (res == 1 && job->condition == JOBCOND_RUN){    //continued after a stop
+    printf("=== JOB %d CONTINUED %s [#%d] ===\n", jobnum, job->jobname, job->pid);
+  } else if (res == 1){    //if update results is 1 or child is completed
     printf("=== JOB %d COMPLETED %s [#%d]: %s ===\n", jobnum, shellac->jobs[jobnum]->jobname, shellac->jobs[jobnum]->pid, job_condition_str(shellac->jobs[jobnum]));
+    session_job_done(&shellac->session, jobnum, shellac->jobs[jobnum]);    //accounts and logs the completion
     shellac_remove_job(shellac, jobnum);    //removes the current job
     }
   return;
@@ -126,11 +160,159 @@ void shellac_wait_one(shellac_t *shellac, int jobnum){
 // (e.g. is_background becomes 0) then update that job to wait for
 // it. Does basic error checking so that if the jobnum indicated
 // doesn't exit, an error message of some sort is printed.
-  if (shellac->jobs[jobnum] != NULL){    //if the current is not NULL
-    shellac->jobs[jobnum]->is_background = 0;    //sets the is_background to 0
-    job_update_status(shellac->jobs[jobnum]);    //updates the current job
+//
+// A stopped job is continued first as it would otherwise never
+// finish. The job is reported and removed via shellac_update_one()
+// once it completes, or reported again if it stops.
+  if (jobnum >= 0 && jobnum < MAX_JOBS && shellac->jobs[jobnum] != NULL){    //if the current is not NULL
+    job_t *job = shellac->jobs[jobnum];
+    if (job->condition == JOBCOND_STOP){    //resume before waiting
+      killpg(job->pid, SIGCONT);
+      job->condition = JOBCOND_RUN;
+    }
+    job->is_background = 0;    //sets the is_background to 0
+    shellac_update_one(shellac, jobnum);    //waits on, reports, and removes the current job
   } else {
     printf("ERROR: No job '%d' to wait for\n", jobnum);    //prints error
   }
   return;
 }
+
+void shellac_wait_all(shellac_t *shellac){
+// Waits for every remaining job to finish by bringing each to the
+// foreground and updating it, reporting and removing it as
+// shellac_update_one() does. Used to drain background jobs at the end
+// of a replay so its elapsed time covers all the work.
+  for(int i = 0; i < MAX_JOBS; i++){    //loops through the jobs array
+    if (shellac->jobs[i] != NULL){    //if the current job is not NULL
+      shellac_wait_one(shellac, i);    //continues it if stopped and blocks until it finishes
+    }
+  }
+  return;
+}
+
+int shellac_signal_jobs(shellac_t *shellac, char *target, int sig){
+// Sends sig to the process group of every job selected by target,
+// reaching any children the jobs spawned as well. target is one of
+//
+//   %N     job number N
+//   %N-M   job numbers N through M inclusive
+//   all    every job
+//   name   every job whose jobname is name, e.g. "sleep"
+//
+// Stopped jobs are also sent SIGCONT after any signal other than a stop
+// so that they act on it. Prints a summary line of the form
+//
+// === SIGNALED 3 JOBS: Terminated ===
+//
+// and returns the number of jobs signaled. Prints an error for a bad
+// target or if no jobs match. Condition changes are picked up by the
+// next shellac_update_all().
+  int lo = 0, hi = MAX_JOBS-1;    //range of job numbers to consider
+  char *name = NULL;    //jobname to match or NULL for any
+  if (target[0] == '%'){
+    int n = sscanf(target, "%%%d-%d", &lo, &hi);
+    if (n == 1){    //single job
+      hi = lo;
+    } else if (n != 2){
+      printf("ERROR: Bad job specification '%s'\n", target);
+      return 0;
+    }
+    if (lo < 0) lo = 0;
+    if (hi > MAX_JOBS-1) hi = MAX_JOBS-1;
+  } else if (strcmp("all", target) != 0){
+    name = target;
+  }
+  int count = 0;    //number of jobs signaled
+  for (int i = lo; i <= hi; i++){    //loops through the selected jobs
+    job_t *job = shellac->jobs[i];
+    if (job == NULL || job->pid <= 0 ||
+        (job->condition != JOBCOND_RUN && job->condition != JOBCOND_STOP)){
+      continue;    //nothing running to signal
+    }
+    if (name != NULL && strcmp(name, job->jobname) != 0){
+      continue;
+    }
+    if (killpg(job->pid, sig) == -1){
+      Dprintf("shellac_signal_jobs(): killpg(%d,%d) failed: %s\n", job->pid, sig, strerror(errno));
+      continue;
+    }
+    if (job->condition == JOBCOND_STOP &&
+        sig != SIGSTOP && sig != SIGTSTP && sig != SIGCONT){    //wake it to handle sig
+      killpg(job->pid, SIGCONT);
+    }
+    count++;
+  }
+  if (count == 0){
+    printf("ERROR: No jobs match '%s'\n", target);
+  } else {
+    printf("=== SIGNALED %d JOBS: %s ===\n", count, strsignal(sig));
+  }
+  return count;
+}
+
+int shellac_outfd_acquire(shellac_t *shellac, char *path){
+// Returns a descriptor open for appending to path, shared with any
+// other running jobs appending to the same path, and bumps its
+// reference count. The first acquire opens the file with O_APPEND so
+// writes from different jobs never overwrite one another, and with
+// O_CLOEXEC so children only see it once dup2()'d onto stdout/stderr.
+// Returns -1 if the file can't be opened or the cache is full; the
+// caller should then let the child open the file itself.
+//
+// A cached descriptor is only reused while its file is still linked
+// into the filesystem, checked with fstat() on the descriptor so no
+// path lookup is needed. If the file was removed, e.g. by log rotation,
+// a new entry is opened and the old one is closed once the jobs still
+// writing to it are removed. A file that was only renamed is still
+// linked, so jobs keep appending to it under its new name until every
+// job using the entry has finished.
+  int free_idx = -1;    //first unused cache entry
+  for (int i = 0; i < MAX_OUTFDS; i++){    //loops through the descriptor cache
+    if (shellac->outfds[i].path == NULL){
+      if (free_idx == -1){
+        free_idx = i;
+      }
+    } else if (strcmp(shellac->outfds[i].path, path)==0){    //same name, check file still exists
+      struct stat fd_st;
+      if (fstat(shellac->outfds[i].fd, &fd_st) == 0 && fd_st.st_nlink > 0){    //already open for another job
+        shellac->outfds[i].refcount++;
+        return shellac->outfds[i].fd;
+      }
+    }
+  }
+  if (free_idx == -1){    //cache full
+    Dprintf("shellac_outfd_acquire(): cache full, not sharing '%s'\n", path);
+    return -1;
+  }
+  int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, S_IRUSR|S_IWUSR);
+  if (fd == -1){    //child will retry and exit with JOBCOND_FAIL_OUTP
+    return -1;
+  }
+  shellac->outfds[free_idx].path = strdup(path);
+  shellac->outfds[free_idx].fd = fd;
+  shellac->outfds[free_idx].refcount = 1;
+  return fd;
+}
+
+void shellac_outfd_release(shellac_t *shellac, int fd){
+// Drops one reference to a descriptor handed out by
+// shellac_outfd_acquire(). Closes it and frees the cache entry when
+// the last job using it is removed. Does nothing for fd -1.
+  if (fd == -1){
+    return;
+  }
+  for (int i = 0; i < MAX_OUTFDS; i++){    //loops through the descriptor cache
+    if (shellac->outfds[i].path != NULL && shellac->outfds[i].fd == fd){
+      shellac->outfds[i].refcount--;
+      if (shellac->outfds[i].refcount == 0){    //last user gone
+        close(fd);
+        free(shellac->outfds[i].path);
+        shellac->outfds[i].path = NULL;
+        shellac->outfds[i].fd = -1;
+      }
+      return;
+    }
+  }
+  Dprintf("shellac_outfd_release(): fd %d not in cache\n", fd);
+}
@@ -69,6 +69,19 @@ job_t *job_new(char *argv[]){
 // the argv[] and sets appropriate other fields. If problems are found
 // with input/output redirection such as a ">" with no following file,
 // prints an error and return NULL.
+//
+// Output redirection also accepts the append and stderr forms:
+//
+//   >> outfile    append stdout to outfile
+//   2> errfile    send stderr to errfile, 2>> appends instead
+//   2>&1          send stderr wherever stdout goes
+//   &> outfile    send both stdout and stderr to outfile, &>> appends
+//
+// A later redirection of the same stream replaces an earlier one.
+// Redirections apply left to right as in other shells: "2>&1 > file"
+// leaves stderr on the original stdout while "> file 2>&1" sends both
+// to file. Moving stdout again once "2>&1" or "&>" has tied stderr to a file,
+// as in "> a 2>&1 > b", is not supported and is reported as an error.
 // 
 // HINTS for PROBLEM 3: The provided array_shift() function from the
 // shellac_util.c may prove useful to shift over input / output
@@ -85,26 +98,76 @@ job_t *job_new(char *argv[]){
   int l = count + 1;    //length of the argv with NULL included
   job->input_file = NULL;    //initializes input_file as NULL
   job->output_file = NULL;    //initializes output_file as NULL
+  job->error_file = NULL;    //initializes error_file as NULL
+  job->output_append = 0;    //stdout truncates by default
+  job->error_append = 0;    //stderr truncates by default
+  job->error_to_output = 0;    //stderr is not merged by default
+  job->output_fd = -1;    //no shared descriptor until started
+  job->error_fd = -1;    //no shared descriptor until started
   job->is_background = 0;    //initializes is_background as 0
+  job->start_time = 0.0;    //stamped when the job is started
   while(argv[a] != NULL){    //loops through the argv[] array up to NULL element
     if(strcmp("<", argv[a])==0){    //if the current element is "<"
       if(argv[a+1] == NULL){    //check if the next element is not NULL
         printf("ERROR: No file given for input redirection\n");    //if NULL, print the error
+        free(job->input_file);    //frees any earlier redirection names
+        free(job->output_file);
+        free(job->error_file);
         free(job);    //frees the job struct
         return NULL;    //returns NULL for error
       }
+      free(job->input_file);    //drops an earlier input redirection
       job->input_file = strdup(argv[a+1]);    //copies the next element into input_file
       array_shift(argv, a, l--);    //array shift the current element left
       array_shift(argv, a, l--);    //array shift the next element left
-    } else if (strcmp(">", argv[a])==0){    //if the current element is ">"
+    } else if (strcmp(">", argv[a])==0 || strcmp(">>", argv[a])==0 ||
+               strcmp("&>", argv[a])==0 || strcmp("&>>", argv[a])==0){    //if the current element redirects stdout
       if(argv[a+1] == NULL){    //check if the next element is not NULL
         printf("ERROR: No file given for output redirection\n");    //if NULL, print the error
+        free(job->input_file);    //frees any earlier redirection names
+        free(job->output_file);
+        free(job->error_file);
         free(job);    //frees the job struct
         return NULL;    //returns NULL for error
       }
+      if(job->error_to_output == 1 && argv[a][0] != '&'){    //stderr already follows an earlier file
+        printf("ERROR: Output redirection after 2>&1 to a file is not supported\n");
+        free(job->input_file);
+        free(job->output_file);
+        free(job->error_file);
+        free(job);
+        return NULL;
+      }
+      free(job->output_file);    //drops an earlier output redirection
       job->output_file = strdup(argv[a+1]);    //copies the next element into output_file
+      job->output_append = strstr(argv[a], ">>") != NULL;    //">>" and "&>>" append
+      if (argv[a][0] == '&'){    //"&>" and "&>>" also carry stderr along
+        free(job->error_file);
+        job->error_file = NULL;
+        job->error_to_output = 1;
+      }
+      array_shift(argv, a, l--);    //array shift the current element left
+      array_shift(argv, a, l--);    //array shift the next element left
+    } else if (strcmp("2>", argv[a])==0 || strcmp("2>>", argv[a])==0){    //if the current element redirects stderr
+      if(argv[a+1] == NULL){    //check if the next element is not NULL
+        printf("ERROR: No file given for error redirection\n");    //if NULL, print the error
+        free(job->input_file);    //frees any earlier redirection names
+        free(job->output_file);
+        free(job->error_file);
+        free(job);    //frees the job struct
+        return NULL;    //returns NULL for error
+      }
+      free(job->error_file);    //drops an earlier error redirection
+      job->error_file = strdup(argv[a+1]);    //copies the next element into error_file
+      job->error_append = strcmp("2>>", argv[a])==0;    //"2>>" appends
+      job->error_to_output = 0;    //an explicit file overrides 2>&1
       array_shift(argv, a, l--);    //array shift the current element left
       array_shift(argv, a, l--);    //array shift the next element left
+    } else if (strcmp("2>&1", argv[a])==0){    //if stderr should follow stdout
+      free(job->error_file);    //drops an earlier error redirection
+      job->error_file = NULL;
+      job->error_to_output = job->output_file != NULL ? 1 : 2;    //redirected or original stdout
+      array_shift(argv, a, l--);    //array shift the current element left
     } else if (strcmp("&", argv[a])==0){    //check if current element is &
       job->is_background = 1;    //set is_background to 1
       array_shift(argv, a, l--);    //array shift the current element left
@@ -127,8 +190,9 @@ job_t *job_new(char *argv[]){
 
 void job_free(job_t *job){
 // Deallocates a job structure. Deallocates the strings in the argv[]
-// array. Deallocates any input / output file associated with
-// fields. Finally de-allocates the struct itself.
+// array. Deallocates any input / output / error file associated with
+// fields. Finally de-allocates the struct itself. Shared descriptors
+// in output_fd / error_fd belong to shellac and are not closed here.
   int i = 0;    //index variable
   while(job->argv[i] != NULL){    //loops through argv[] up to NULL
     free(job->argv[i]);    //free all the duplicate elements
@@ -140,10 +204,23 @@ void job_free(job_t *job){
   if(job->output_file != NULL){    //if output_file not NULL
     free(job->output_file);    //free the duplicate name
   }
+  if(job->error_file != NULL){    //if error_file not NULL
+    free(job->error_file);    //free the duplicate name
+  }
   free(job);    //free the job struct itself
   return;
 }
 
+static void job_give_terminal(pid_t pgid){
+// Makes process group pgid the foreground group of the controlling
+// terminal when shellac is run interactively so that terminal reads
+// and Ctrl-C / Ctrl-Z go to it. Relies on SIGTTOU being ignored so a
+// background group may reclaim the terminal.
+  if (isatty(STDIN_FILENO)){
+    tcsetpgrp(STDIN_FILENO, pgid);
+  }
+}
+
 void job_start(job_t *job){
 // Forks a process and executes the command described in the job as a
 // process.  Changes the condition field to "RUN".
@@ -153,9 +230,26 @@ void job_start(job_t *job){
 // ensures any output files are created and if they already exist, are
 // "clobbered" via appropriate options to open(). If input/output
 // redirection fails, the child process should exit with JOBCOND_FAIL_OUTP or INP.
+//
+// Appended output / error files may already be open in output_fd /
+// error_fd, shared through shellac's descriptor cache; these are
+// dup2()'d directly and the child skips open(). Otherwise the child
+// opens the file itself with O_APPEND or O_TRUNC as requested. Failing
+// to redirect stderr also exits with JOBCOND_FAIL_OUTP.
+//
+// Each job is placed in its own process group whose ID is the job's
+// pid, so it and any children it spawns can be signaled at once with
+// killpg(). Both parent and child call setpgid() to avoid racing on
+// which runs first. Foreground jobs are also given the terminal.
   job->condition = JOBCOND_RUN;    //set the condition to RUN(2)
+  fflush(stdout);    //child must not inherit and repeat buffered shellac output
   job->pid = fork();    //forks a process
   if (job->pid == 0){    //if pid is child's
+    setpgid(0, 0);    //new process group led by this child
+    if (!job->is_background){
+      job_give_terminal(getpid());
+    }
+    signal(SIGTTOU, SIG_DFL);    //undo shellac's ignore, which exec() would keep
     if (job->input_file != NULL){    //if input_file is not NULL
       int fd = open(job->input_file, O_RDONLY);    //open the input_file
       if(fd == -1){                    // check for errors opening file
@@ -164,17 +258,44 @@ void job_start(job_t *job){
       dup2(fd,STDIN_FILENO);    //change the file descripter for input to the open file
       close(fd);    //closes the file
     }
-    if (job->output_file != NULL){
-      int fd = open(job->output_file, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR|S_IWUSR);
+    if (job->error_to_output == 2){    //"2>&1" before any stdout redirection
+      dup2(STDOUT_FILENO,STDERR_FILENO);    //stderr keeps the original stdout
+    }
+    if (job->output_fd != -1){    //shared descriptor from the parent
+      if(dup2(job->output_fd,STDOUT_FILENO) == -1){
+        exit(JOBCOND_FAIL_OUTP);
+      }
+    } else if (job->output_file != NULL){
+      int mode = job->output_append ? O_APPEND : O_TRUNC;    //">>" appends, ">" clobbers
+      int fd = open(job->output_file, O_WRONLY | O_CREAT | mode, S_IRUSR|S_IWUSR);
       if(fd == -1){                    // check for errors opening file
         exit(JOBCOND_FAIL_OUTP);    // exits if open fails
       }
       dup2(fd,STDOUT_FILENO);    //change the file descripter for output to the open file
       close(fd);    //closes the file
     }
+    if (job->error_fd != -1){    //shared descriptor from the parent
+      if(dup2(job->error_fd,STDERR_FILENO) == -1){
+        exit(JOBCOND_FAIL_OUTP);
+      }
+    } else if (job->error_file != NULL){
+      int mode = job->error_append ? O_APPEND : O_TRUNC;    //"2>>" appends, "2>" clobbers
+      int fd = open(job->error_file, O_WRONLY | O_CREAT | mode, S_IRUSR|S_IWUSR);
+      if(fd == -1){                    // check for errors opening file
+        exit(JOBCOND_FAIL_OUTP);    // exits if open fails
+      }
+      dup2(fd,STDERR_FILENO);    //change the file descripter for errors to the open file
+      close(fd);    //closes the file
+    } else if (job->error_to_output == 1){    //"> file 2>&1" or "&>"
+      dup2(STDOUT_FILENO,STDERR_FILENO);    //stderr shares the redirected stdout
+    }
     execvp(job->jobname, job->argv);    //execute the child
     exit(JOBCOND_FAIL_EXEC);    //exits if execute fails
   } else {
+    setpgid(job->pid, job->pid);    //same as the child's call, whichever runs first
+    if (!job->is_background){
+      job_give_terminal(job->pid);
+    }
     return;    //return if parent
   }
 }
@@ -198,14 +319,36 @@ int job_update_status(job_t *job){
 // job without a pid, the behavior of this function is implementation
 // dependent (may segfault, may exit with an error message, etc.) This
 // situation is not tested.
+//
+// Stops and continues are also reported via WUNTRACED / WCONTINUED and
+// return 1: a stopped job becomes STOP and is moved to the background
+// so the shell regains control; a continued job goes back to RUN. Jobs
+// terminated by a signal become KILL with the signal number in retval.
+// Foreground waits hold the terminal for the job while blocked.
   int status = 0;    //status variable
   int retcode = 0;    //pid variable
   if (job->is_background == 0){
-    retcode = waitpid(job->pid, &status, 0);    //waits on child by blocking
+    job_give_terminal(job->pid);    //job may have been started in the background
+    retcode = waitpid(job->pid, &status, WUNTRACED);    //waits on child by blocking
+    job_give_terminal(getpgrp());    //terminal back to shellac
   } else {
-    retcode = waitpid(job->pid, &status, WNOHANG);    //waits on child by not blocking
+    retcode = waitpid(job->pid, &status, WNOHANG | WUNTRACED | WCONTINUED);    //waits on child by not blocking
   }
   if (retcode != 0){   //if reaches finishes
+    if(WIFSTOPPED(status)){    //Ctrl-Z, stop builtin, or SIGSTOP
+      job->condition = JOBCOND_STOP;
+      job->is_background = 1;    //don't block on a stopped job
+      return 1;
+    }
+    if(WIFCONTINUED(status)){    //cont builtin or SIGCONT
+      job->condition = JOBCOND_RUN;
+      return 1;
+    }
+    if(WIFSIGNALED(status)){    //killed by a signal
+      job->condition = JOBCOND_KILL;
+      job->retval = WTERMSIG(status);    //retval holds the signal number
+      return 1;
+    }
     if(WIFEXITED(status)){    //checks if completed successfully
       int ret = WEXITSTATUS(status);    //gets exit status
       if (ret <= 3){    //if exit status less than or equal to 3
@@ -214,6 +357,10 @@ int job_update_status(job_t *job){
       } else if (ret == 128) {
         printf("ERROR: job failed to exec: No such file or directory\n");    //print error
         job->condition = JOBCOND_FAIL_EXEC;    //set condition to FAIL
+      } else if (ret == JOBCOND_FAIL_OUTP) {    //output or error redirection failed in child
+        job->condition = JOBCOND_FAIL_OUTP;
+      } else if (ret == JOBCOND_FAIL_INPT) {    //input redirection failed in child
+        job->condition = JOBCOND_FAIL_INPT;
       } else {
         job->condition = JOBCOND_FAIL_OTHER;    //set condition to fail other
       }
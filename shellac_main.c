@@ -8,16 +8,49 @@ exit               : exit the program\n\
 jobs               : list all background jobs that are currently running\n\
 pause <secs>       : pause for the given number of seconds, fractional values supported\n\
 wait <jobnum>      : wait for given background job to finish, error if no such job is present\n\
+kill [-N] <jobs>   : send signal N (default TERM) to jobs: %n, %n-m, all, or a command name\n\
+stop <jobs>        : stop jobs, selected as for kill\n\
+cont <jobs>        : continue stopped jobs in the background, selected as for kill\n\
 tokens [arg1] ...  : print out all the tokens on this input line to see how they apper\n\
 command [arg1] ... : Non-built-in is run as a job\n\
 ";
   printf(helpstr);
 }
 
+void print_usage(){
+  char *usagestr = "\
+usage: shellac [options]\n\
+--echo             : echo each command after the prompt\n\
+--record <file>    : log input lines and job start/exit times to file; waits for jobs at end\n\
+--replay <file>    : re-issue the input lines of a record file instead of reading stdin\n\
+--speed <x|max>    : replay at x times the recorded speed or as fast as possible; default 1\n\
+";
+  printf(usagestr);
+}
+
 int main(int argc, char *argv[]){
   int echo = 0;                                //controls echoing, 0: echo off, 1: echo on
-  if(argc > 1 && strcmp("--echo",argv[1])==0) { //turn echoing on via -echo command line option
-    echo=1;
+  char *record_file = NULL;                    //--record log to write or NULL
+  char *replay_file = NULL;                    //--replay log to read or NULL
+  double speed = 1.0;                          //--speed factor for replay, 0 for max
+  for(int i = 1; i < argc; i++){               //parse command line options
+    if(strcmp("--echo",argv[i])==0) {          //turn echoing on via -echo command line option
+      echo=1;
+    } else if(strcmp("--record",argv[i])==0 && i+1 < argc){
+      record_file = argv[++i];
+    } else if(strcmp("--replay",argv[i])==0 && i+1 < argc){
+      replay_file = argv[++i];
+    } else if(strcmp("--speed",argv[i])==0 && i+1 < argc){
+      i++;
+      speed = strcmp("max",argv[i])==0 ? 0.0 : strtod(argv[i], NULL);
+      if(speed <= 0 && strcmp("max",argv[i])!=0){
+        printf("ERROR: Bad replay speed '%s'\n", argv[i]);
+        return 1;
+      }
+    } else {
+      print_usage();
+      return 1;
+    }
   }
   
   char input[5000];    //direct user input
@@ -26,14 +59,36 @@ int main(int argc, char *argv[]){
   int ntok;    //number of tokens variable
   shellac_t shellac;    //eclaring shuttle
   shellac_init(&shellac);    //initializing shuttle
+  signal(SIGTTOU, SIG_IGN);    //lets shellac take the terminal back from foreground jobs
+  replay_t replay;    //recorded lines when replaying
+  if(replay_file != NULL){
+    if(replay_load(&replay, replay_file, speed) != 0){
+      return 1;
+    }
+    echo = 1;    //replayed lines don't appear on the terminal otherwise
+  }
+  if(record_file != NULL && session_record_open(&shellac.session, record_file) != 0){
+    if(replay_file != NULL){
+      replay_free(&replay);
+    }
+    return 1;
+  }
+  if(record_file != NULL || replay_file != NULL){
+    session_track_exits(&shellac.session);    //stamp job exit times from SIGCHLD
+  }
 
   while(1){
     printf("(shellac) ");
-    result = fgets(input, 5000, stdin);    //reads the input
+    if(replay_file != NULL){    //next recorded line once it is due
+      result = replay_next(&replay, input, 5000) ? input : NULL;
+    } else {
+      result = fgets(input, 5000, stdin);    //reads the input
+    }
     if(result == NULL){                 //check for end of input
       printf("\nEnd of input\n");     //found end of input
       break;                          
     }
+    session_line(&shellac.session, input);    //log before tokenizing alters input
     if (result[0] == '\n'){    //check for enter as input to avoid seg errors
       tokens[0] = "\n";    //sets token[0] as enter
     } else {
@@ -71,6 +126,32 @@ int main(int argc, char *argv[]){
       }
       shellac_wait_one(&shellac, atoi(tokens[1]));    //calls shellac_wait_one
     }
+    else if( strcmp("kill", tokens[0])==0 || strcmp("stop", tokens[0])==0 ||
+             strcmp("cont", tokens[0])==0 ){ //job signaling commands
+      if(echo){    //check for echo
+        printf("%s", tokens[0]);
+        for (int i = 1; i < ntok; i++){ //loop to repeat tokens
+          printf(" %s", tokens[i]);
+        }
+        printf("\n");
+      }
+      int sig = SIGTERM;    //kill default
+      int t = 1;    //index of the job target
+      if(strcmp("stop", tokens[0])==0){
+        sig = SIGSTOP;
+      } else if(strcmp("cont", tokens[0])==0){
+        sig = SIGCONT;
+      } else if(ntok > 2 && tokens[1][0] == '-'){    //kill -N target
+        sig = atoi(tokens[1]+1);
+        t = 2;
+      }
+      if(t >= ntok || sig <= 0 || sig >= NSIG){
+        printf("ERROR: usage: %s%s <%%n|%%n-m|all|name>\n", tokens[0],
+               strcmp("kill", tokens[0])==0 ? " [-N]" : "");
+      } else {
+        shellac_signal_jobs(&shellac, tokens[t], sig);    //killpg() each selected job
+      }
+    }
     else if( strcmp("tokens", tokens[0])==0 ){ //tokens command         
       if(echo){    //check for echo
         printf("tokens");
@@ -100,7 +181,10 @@ int main(int argc, char *argv[]){
         i++;    //increases the index
       }
       job_t *job = job_new(tokens);    //creates a job struct with tokens as its argument
-      int res = shellac_add_job(&shellac, job);    //adds the job to shellac
+      int res = 1;    //nothing to start if job_new() reported an error
+      if (job != NULL){
+        res = shellac_add_job(&shellac, job);    //adds the job to shellac
+      }
       if (res == 0){
         shellac_start_job(&shellac, i);    //starts the current job
         shellac_update_one(&shellac, i);    //updates the current job
@@ -108,6 +192,14 @@ int main(int argc, char *argv[]){
     }
     shellac_update_all(&shellac);    //updates all the jobs in shellac
   }
+  if(record_file != NULL || replay_file != NULL){
+    shellac_wait_all(&shellac);    //record and replay both cover every job started
+  }
+  if(replay_file != NULL){
+    replay_report(&replay, &shellac.session);
+    replay_free(&replay);
+  }
+  session_close(&shellac.session);    //ends the record log if any
   shellac_free_jobs(&shellac);    //free all the jobs in shellac
   return 0;
 }
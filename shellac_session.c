@@ -0,0 +1,319 @@
+#include "shellac.h"
+// shellac_session.c: functions to record a shellac session with its
+// timing and to replay a recording as a reproducible load test.
+//
+// A record log is plain text with one event per line. Times are in
+// seconds since the session began.
+//
+//   # shellac record
+//   L <time> <input line>                  input line arrived
+//   S <time> <jobnum> <pid> <jobname>      job started
+//   C <time> <jobnum> <pid> <secs> <cond>  job exited after secs
+//   E <time>                               session ended
+//
+// When recording or replaying, C times are when the job exited,
+// stamped from a SIGCHLD handler, not when shellac got around to
+// reaping it. C records are written at reaping so they may appear
+// after later L / S records. Both modes wait for outstanding jobs at
+// end of input so every S record has a matching C record.
+//
+// Replay re-issues the L lines at their recorded times divided by the
+// speed factor, or back to back at maximum speed, then compares the
+// elapsed time, throughput and job latency with the S / C records.
+// Elapsed time runs to the last input line or job exit, whichever is
+// later, so idle time before end of input is not counted.
+
+// Exit times stamped by session_sigchld(), indexed by job number. A pid
+// of 0 marks a slot with no running job and a time below 0 a job that
+// hasn't exited yet. Static as the signal handler can't be handed the
+// shellac_t.
+static volatile sig_atomic_t exit_tracking;    // 1 once session_track_exits() was called
+static volatile sig_atomic_t exit_pids[MAX_JOBS];
+static volatile double exit_times[MAX_JOBS];
+static volatile double exit_last;    // time of the latest SIGCHLD for a job exit
+static double exit_epoch;    // session epoch for exit_times[]
+
+double time_now(){
+// Returns the current monotonic time in seconds. Used for all session
+// timestamps so that wall clock adjustments don't skew a recording.
+  struct timespec tm;
+  clock_gettime(CLOCK_MONOTONIC, &tm);
+  return tm.tv_sec + tm.tv_nsec / 1.0e9;
+}
+
+static void session_sigchld(int sig, siginfo_t *info, void *context){
+// SIGCHLD handler which stamps the exit time of the job whose pid is
+// in info. Stops and continues also raise SIGCHLD and are ignored.
+// Several exits while a SIGCHLD is pending are merged into one signal
+// that names only one of them; exit_last lets session_job_done() give
+// the others the time of that signal instead.
+  (void)sig;
+  (void)context;
+  if (info->si_code != CLD_EXITED && info->si_code != CLD_KILLED && info->si_code != CLD_DUMPED){
+    return;
+  }
+  double now = time_now() - exit_epoch;
+  exit_last = now;
+  for (int i = 0; i < MAX_JOBS; i++){
+    if (exit_pids[i] == info->si_pid){
+      if (exit_times[i] < 0){
+        exit_times[i] = now;
+      }
+      return;
+    }
+  }
+}
+
+void session_init(session_t *session){
+// Starts session timing now with no record log and zeroed counters.
+// Job exit times are only stamped after session_track_exits();
+// otherwise a job's latency runs until it is reaped.
+  session->record = NULL;
+  session->epoch = time_now();
+  session->lines = 0;
+  session->jobs_started = 0;
+  session->jobs_done = 0;
+  session->job_secs = 0.0;
+  session->last_event = 0.0;
+  exit_tracking = 0;
+  exit_epoch = session->epoch;
+  exit_last = -1.0;
+  for (int i = 0; i < MAX_JOBS; i++){
+    exit_pids[i] = 0;
+    exit_times[i] = -1.0;
+  }
+}
+
+void session_track_exits(session_t *session){
+// Installs the SIGCHLD handler that stamps job exit times as they
+// happen. Only used when recording or replaying so that an ordinary
+// session doesn't pay for it. SA_RESTART keeps blocking reads and waits
+// from failing with EINTR.
+  exit_epoch = session->epoch;
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_sigaction = session_sigchld;
+  sa.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGCHLD, &sa, NULL);
+  exit_tracking = 1;
+}
+
+int session_record_open(session_t *session, char *path){
+// Opens path as the record log for the session, clobbering any
+// existing file. Opened close-on-exec so jobs don't inherit it. Prints
+// an error and returns 1 if it can't be opened, otherwise returns 0.
+  session->record = fopen(path, "we");
+  if (session->record == NULL){
+    printf("ERROR: Couldn't open record file '%s'\n", path);
+    return 1;
+  }
+  fprintf(session->record, "# shellac record\n");
+  return 0;
+}
+
+void session_close(session_t *session){
+// Writes the end of session marker and closes the record log if one
+// is open.
+  if (session->record != NULL){
+    fprintf(session->record, "E %.6f\n", time_now() - session->epoch);
+    fclose(session->record);
+    session->record = NULL;
+  }
+}
+
+void session_line(session_t *session, char *line){
+// Counts an input line and logs it with its arrival time. The line
+// must be logged before tokenize_string() alters it. The log is
+// flushed per line so a session that is killed keeps its input.
+  double now = time_now() - session->epoch;
+  session->lines++;
+  if (now > session->last_event){
+    session->last_event = now;
+  }
+  if (session->record != NULL){
+    int len = strcspn(line, "\n");    //drop the trailing newline
+    fprintf(session->record, "L %.6f %.*s\n", now, len, line);
+    fflush(session->record);
+  }
+}
+
+void session_job_start(session_t *session, int jobnum, job_t *job){
+// Stamps the start time of a job that was just started and logs it.
+// When tracking exits, registers the job for its SIGCHLD and checks
+// whether it already exited before it was registered.
+  job->start_time = time_now() - session->epoch;
+  session->jobs_started++;
+  if (exit_tracking){
+    exit_times[jobnum] = -1.0;
+    exit_pids[jobnum] = job->pid;
+    siginfo_t info;
+    info.si_pid = 0;    //stays 0 if the job is still running
+    if (waitid(P_PID, job->pid, &info, WEXITED | WNOHANG | WNOWAIT) == 0 && info.si_pid != 0){
+      exit_times[jobnum] = time_now() - session->epoch;    //WNOWAIT leaves it for job_update_status()
+    }
+  }
+  if (session->record != NULL){
+    fprintf(session->record, "S %.6f %d %d %s\n",
+            job->start_time, jobnum, job->pid, job->jobname);
+  }
+}
+
+void session_job_done(session_t *session, int jobnum, job_t *job){
+// Accounts for a completed job's start-to-exit time and logs it along
+// with its final condition. Uses the exit time stamped on SIGCHLD. A
+// job whose SIGCHLD was merged with another's uses the time of the
+// latest SIGCHLD after it started, and without exit tracking the
+// current time is used.
+  double now = time_now() - session->epoch;
+  if (exit_times[jobnum] >= 0){
+    now = exit_times[jobnum];
+  } else if (exit_tracking && exit_last >= job->start_time){
+    now = exit_last;
+  }
+  double secs = now - job->start_time;
+  exit_pids[jobnum] = 0;    //slot free for the next job with this number
+  session->jobs_done++;
+  session->job_secs += secs;
+  if (now > session->last_event){
+    session->last_event = now;
+  }
+  if (session->record != NULL){
+    fprintf(session->record, "C %.6f %d %d %.6f %s\n",
+            now, jobnum, job->pid, secs, job_condition_str(job));
+  }
+}
+
+int replay_load(replay_t *replay, char *path, double speed){
+// Reads the record log in path into replay. Keeps every L line for
+// re-issuing and totals the S / C / E records for the comparison in
+// replay_report(). speed scales the recorded timing; 0 issues lines
+// as fast as possible. Prints an error and returns 1 if the file can't
+// be read, otherwise returns 0.
+  FILE *fin = fopen(path, "r");
+  if (fin == NULL){
+    printf("ERROR: Couldn't open replay file '%s'\n", path);
+    return 1;
+  }
+  replay->lines = NULL;
+  replay->times = NULL;
+  replay->count = 0;
+  replay->next = 0;
+  replay->speed = speed;
+  replay->epoch = 0.0;
+  replay->rec_jobs_started = 0;
+  replay->rec_jobs_done = 0;
+  replay->rec_job_secs = 0.0;
+  replay->rec_elapsed = 0.0;
+
+  int capacity = 0;
+  char *buf = NULL;
+  size_t bufsize = 0;
+  ssize_t len;
+  while ((len = getline(&buf, &bufsize, fin)) != -1){    //one event per line
+    if (len > 0 && buf[len-1] == '\n'){
+      buf[len-1] = '\0';
+    }
+    double time = 0.0;
+    int off = 0;
+    if (sscanf(buf, "%*c %lf%n", &time, &off) < 1){    //comment or malformed
+      continue;
+    }
+    if (buf[0] != 'E' && time > replay->rec_elapsed){    //last line or job exit
+      replay->rec_elapsed = time;
+    }
+    if (buf[0] == 'L'){
+      if (replay->count == capacity){    //grow the line arrays
+        capacity = capacity == 0 ? 64 : 2 * capacity;
+        replay->lines = realloc(replay->lines, capacity * sizeof(char *));
+        replay->times = realloc(replay->times, capacity * sizeof(double));
+      }
+      char *text = buf + off;
+      if (*text == ' '){    //single separator before the line text
+        text++;
+      }
+      replay->lines[replay->count] = strdup(text);
+      replay->times[replay->count] = time;
+      replay->count++;
+    } else if (buf[0] == 'S'){
+      replay->rec_jobs_started++;
+    } else if (buf[0] == 'C'){
+      double secs = 0.0;
+      if (sscanf(buf + off, "%*d %*d %lf", &secs) == 1){
+        replay->rec_jobs_done++;
+        replay->rec_job_secs += secs;
+      }
+    }
+  }
+  free(buf);
+  fclose(fin);
+  Dprintf("replay_load(): %d lines over %.3f secs from '%s'\n",
+          replay->count, replay->rec_elapsed, path);
+  return 0;
+}
+
+int replay_next(replay_t *replay, char *buf, int size){
+// Copies the next recorded line with a trailing newline into buf as
+// fgets() would. Sleeps until the line is due: its recorded time
+// divided by speed after the first call. If the shell has fallen
+// behind the schedule, the line is issued immediately. Returns 0 once
+// all lines are issued, 1 otherwise.
+  if (replay->next == 0){    //replay clock starts with the first line
+    replay->epoch = time_now();
+  }
+  if (replay->next >= replay->count){
+    return 0;
+  }
+  if (replay->speed > 0){
+    double due = replay->epoch + replay->times[replay->next] / replay->speed;
+    double delay = due - time_now();
+    if (delay > 0){
+      pause_for(delay);
+    }
+  }
+  snprintf(buf, size, "%s\n", replay->lines[replay->next]);
+  replay->next++;
+  return 1;
+}
+
+void replay_report(replay_t *replay, session_t *session){
+// Prints the end-to-end time, job throughput and mean job latency of
+// the replay next to those of the recording along with their ratios.
+// The replay is timed from the first issued line to the last issued
+// line or job exit.
+  double elapsed = session->epoch + session->last_event - replay->epoch;
+  double rec_rate  = replay->rec_elapsed > 0 ? replay->rec_jobs_done / replay->rec_elapsed : 0.0;
+  double rate      = elapsed > 0 ? session->jobs_done / elapsed : 0.0;
+  double rec_mean  = replay->rec_jobs_done > 0 ? replay->rec_job_secs / replay->rec_jobs_done : 0.0;
+  double mean      = session->jobs_done > 0 ? session->job_secs / session->jobs_done : 0.0;
+
+  if (replay->speed > 0){
+    printf("=== REPLAY SUMMARY: speed %.2fx ===\n", replay->speed);
+  } else {
+    printf("=== REPLAY SUMMARY: speed max ===\n");
+  }
+  printf("%-10s %7s %7s %7s %11s %10s %12s\n",
+         "", "lines", "started", "done", "elapsed", "jobs/sec", "mean latency");
+  printf("%-10s %7d %7d %7d %10.3fs %10.3f %11.3fs\n", "recorded",
+         replay->count, replay->rec_jobs_started, replay->rec_jobs_done,
+         replay->rec_elapsed, rec_rate, rec_mean);
+  printf("%-10s %7d %7d %7d %10.3fs %10.3f %11.3fs\n", "replayed",
+         session->lines, session->jobs_started, session->jobs_done,
+         elapsed, rate, mean);
+  printf("%-10s %7s %7s %7s %10.3fx %9.3fx %11.3fx\n", "ratio", "", "", "",
+         replay->rec_elapsed > 0 ? elapsed / replay->rec_elapsed : 0.0,
+         rec_rate > 0 ? rate / rec_rate : 0.0,
+         rec_mean > 0 ? mean / rec_mean : 0.0);
+}
+
+void replay_free(replay_t *replay){
+// De-allocates the lines and times loaded by replay_load().
+  for (int i = 0; i < replay->count; i++){
+    free(replay->lines[i]);
+  }
+  free(replay->lines);
+  free(replay->times);
+  replay->lines = NULL;
+  replay->times = NULL;
+  replay->count = 0;
+}
@@ -53,6 +53,12 @@ char *job_condition_str(job_t *job){
   else if(job->condition == JOBCOND_EXIT){
     snprintf(condition_buf, MAX_LINE, "EXIT(%d)",job->retval);
   }
+  else if(job->condition == JOBCOND_STOP){
+    snprintf(condition_buf, MAX_LINE, "STOP");
+  }
+  else if(job->condition == JOBCOND_KILL){
+    snprintf(condition_buf, MAX_LINE, "KILL(%d)",job->retval);
+  }
   else if(job->condition == JOBCOND_FAIL_EXEC){
     snprintf(condition_buf, MAX_LINE, "FAIL(EXEC)");
   }
@@ -115,7 +121,8 @@ void tokenize_string(char input[], char *tokens[], int *ntok){
 }
   
 // Sleep the running program for the given number of seconds allowing
-// fractional values.
+// fractional values. Resumes sleeping for the remaining time if
+// interrupted by a signal such as SIGCHLD from a finishing job.
 void pause_for(double secs){
   int isecs = (int) secs;
   double frac = secs - ((double) isecs);
@@ -125,7 +132,9 @@ void pause_for(double secs){
     .tv_nsec = inanos,
     .tv_sec  = isecs,
   };
-  nanosleep(&tm,NULL);
+  while(nanosleep(&tm,&tm) == -1 && errno == EINTR){
+    // tm now holds the time remaining
+  }
 }
 
 // shift the array of strings left by 1 starting at delpos; eliminates